@@ -0,0 +1,199 @@
+//
+//  Copyright (c) 2020 plan44.ch / Lukas Zeller, Zurich, Switzerland
+//
+//  Author: Lukas Zeller <luz@plan44.ch>
+//
+//  This file is part of p44featured.
+//
+//  p44featured is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  p44featured is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with p44featured. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "metrics.hpp"
+
+#include <sys/resource.h>
+
+using namespace p44;
+
+#define METRICS_SAMPLE_INTERVAL Second // how often the mainloop lateness is sampled
+
+
+// MARK: - DurationHistogram
+
+const MLMicroSeconds DurationHistogram::bucketLimits[numBuckets] = {
+  100*MicroSecond, MilliSecond, 10*MilliSecond, 100*MilliSecond, Second, 10*Second, Infinite
+};
+
+
+void DurationHistogram::reset()
+{
+  for (int i=0; i<numBuckets; i++) mBuckets[i] = 0;
+  mCount = 0;
+  mSum = 0;
+  mMax = 0;
+}
+
+
+void DurationHistogram::record(MLMicroSeconds aDuration)
+{
+  int i = 0;
+  while (i<numBuckets-1 && aDuration>bucketLimits[i]) i++;
+  mBuckets[i]++;
+  mCount++;
+  mSum += aDuration;
+  if (aDuration>mMax) mMax = aDuration;
+}
+
+
+void DurationHistogram::exposition(string &aText, const string aName, const string aLabels) const
+{
+  string sep = aLabels.empty() ? "" : ",";
+  uint64_t cumulated = 0;
+  for (int i=0; i<numBuckets; i++) {
+    cumulated += mBuckets[i];
+    if (i<numBuckets-1) {
+      string_format_append(aText, "%s_bucket{%s%sle=\"%g\"} %llu\n", aName.c_str(), aLabels.c_str(), sep.c_str(), (double)bucketLimits[i]/Second, (unsigned long long)cumulated);
+    }
+    else {
+      string_format_append(aText, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", aName.c_str(), aLabels.c_str(), sep.c_str(), (unsigned long long)cumulated);
+    }
+  }
+  string lbl = aLabels.empty() ? "" : "{" + aLabels + "}";
+  string_format_append(aText, "%s_sum%s %.6f\n", aName.c_str(), lbl.c_str(), (double)mSum/Second);
+  string_format_append(aText, "%s_count%s %llu\n", aName.c_str(), lbl.c_str(), (unsigned long long)mCount);
+}
+
+
+// MARK: - Metrics
+
+/// escape a prometheus label value
+static string labelEscaped(const string aValue)
+{
+  string res;
+  for (size_t i=0; i<aValue.size(); i++) {
+    char c = aValue[i];
+    if (c=='\\' || c=='"') { res += '\\'; res += c; }
+    else if (c=='\n') res += "\\n";
+    else res += c;
+  }
+  return res;
+}
+
+
+// API routes recorded separately, all others are recorded as "other" to keep the number of histograms bounded
+static const char *knownApiRoutes[] = { "featureapi", "metrics", "log", "mainscript", "scriptapi", NULL };
+
+
+Metrics::Metrics() :
+  mNextSample(Never),
+  mStarted(MainLoop::now())
+{
+}
+
+
+void Metrics::start()
+{
+  mNextSample = MainLoop::now()+METRICS_SAMPLE_INTERVAL;
+  mSampleTicket.executeOnceAt(boost::bind(&Metrics::sampleMainloop, this, _2), mNextSample);
+}
+
+
+void Metrics::reset()
+{
+  mApiLatencies.clear();
+  mScriptTimes.clear();
+  mMainloopLateness.reset();
+}
+
+
+void Metrics::recordApiRequest(const string aApi, const string aUri, MLMicroSeconds aStarted)
+{
+  const char *route = "other";
+  for (const char **rP = knownApiRoutes; *rP; rP++) {
+    if (aUri==*rP) { route = *rP; break; }
+  }
+  mApiLatencies[string_format("api=\"%s\",uri=\"%s\"", labelEscaped(aApi).c_str(), route)].record(MainLoop::now()-aStarted);
+}
+
+
+void Metrics::recordScriptRun(const string aContext, MLMicroSeconds aStarted)
+{
+  MLMicroSeconds elapsed = MainLoop::now()-aStarted;
+  mScriptTimes[aContext].record(elapsed);
+  mScriptAccounting[aContext].record(elapsed);
+}
+
+
+JsonObjectPtr Metrics::scriptAccounting() const
+{
+  JsonObjectPtr acc = JsonObject::newObj();
+  for (HistogramMap::const_iterator pos = mScriptAccounting.begin(); pos!=mScriptAccounting.end(); ++pos) {
+    JsonObjectPtr c = JsonObject::newObj();
+    c->add("runs", JsonObject::newInt64(pos->second.count()));
+    c->add("elapsedtotal", JsonObject::newDouble((double)pos->second.sum()/Second));
+    c->add("elapsedmax", JsonObject::newDouble((double)pos->second.max()/Second));
+    acc->add(pos->first.c_str(), c);
+  }
+  return acc;
+}
+
+
+string Metrics::exposition(int aRequestsPending)
+{
+  string t;
+  t += "# HELP p44featured_api_request_duration_seconds API request latency\n";
+  t += "# TYPE p44featured_api_request_duration_seconds histogram\n";
+  for (HistogramMap::iterator pos = mApiLatencies.begin(); pos!=mApiLatencies.end(); ++pos) {
+    pos->second.exposition(t, "p44featured_api_request_duration_seconds", pos->first);
+  }
+  t += "# HELP p44featured_api_requests_pending API requests currently pending\n";
+  t += "# TYPE p44featured_api_requests_pending gauge\n";
+  string_format_append(t, "p44featured_api_requests_pending %d\n", aRequestsPending);
+  t += "# HELP p44featured_script_duration_seconds elapsed (wall clock) time from script start to completion\n";
+  t += "# TYPE p44featured_script_duration_seconds histogram\n";
+  for (HistogramMap::iterator pos = mScriptTimes.begin(); pos!=mScriptTimes.end(); ++pos) {
+    pos->second.exposition(t, "p44featured_script_duration_seconds", string_format("context=\"%s\"", labelEscaped(pos->first).c_str()));
+  }
+  t += "# HELP p44featured_mainloop_lateness_seconds delay of a periodic mainloop timer beyond its due time\n";
+  t += "# TYPE p44featured_mainloop_lateness_seconds histogram\n";
+  mMainloopLateness.exposition(t, "p44featured_mainloop_lateness_seconds", "");
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru)==0) {
+    t += "# HELP p44featured_cpu_user_seconds_total user CPU time consumed by the process\n";
+    t += "# TYPE p44featured_cpu_user_seconds_total counter\n";
+    string_format_append(t, "p44featured_cpu_user_seconds_total %ld.%06ld\n", (long)ru.ru_utime.tv_sec, (long)ru.ru_utime.tv_usec);
+    t += "# HELP p44featured_cpu_system_seconds_total system CPU time consumed by the process\n";
+    t += "# TYPE p44featured_cpu_system_seconds_total counter\n";
+    string_format_append(t, "p44featured_cpu_system_seconds_total %ld.%06ld\n", (long)ru.ru_stime.tv_sec, (long)ru.ru_stime.tv_usec);
+    #ifdef __APPLE__
+    long maxRss = ru.ru_maxrss; // bytes on macOS
+    #else
+    long maxRss = ru.ru_maxrss*1024; // kilobytes on Linux
+    #endif
+    t += "# HELP p44featured_max_resident_memory_bytes peak resident set size of the process\n";
+    t += "# TYPE p44featured_max_resident_memory_bytes gauge\n";
+    string_format_append(t, "p44featured_max_resident_memory_bytes %ld\n", maxRss);
+  }
+  t += "# HELP p44featured_uptime_seconds time since p44featured was started\n";
+  t += "# TYPE p44featured_uptime_seconds gauge\n";
+  string_format_append(t, "p44featured_uptime_seconds %lld\n", (long long)((MainLoop::now()-mStarted)/Second));
+  return t;
+}
+
+
+void Metrics::sampleMainloop(MLMicroSeconds aNow)
+{
+  mMainloopLateness.record(aNow-mNextSample);
+  mNextSample = aNow+METRICS_SAMPLE_INTERVAL;
+  mSampleTicket.executeOnceAt(boost::bind(&Metrics::sampleMainloop, this, _2), mNextSample);
+}
@@ -0,0 +1,116 @@
+//
+//  Copyright (c) 2020 plan44.ch / Lukas Zeller, Zurich, Switzerland
+//
+//  Author: Lukas Zeller <luz@plan44.ch>
+//
+//  This file is part of p44featured.
+//
+//  p44featured is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  p44featured is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with p44featured. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __p44featured__metrics__
+#define __p44featured__metrics__
+
+#include "p44utils_common.hpp"
+#include "mainloop.hpp"
+#include "jsonobject.hpp"
+
+#include <map>
+
+using namespace std;
+
+namespace p44 {
+
+  /// simple duration histogram with fixed, prometheus style cumulative buckets
+  class DurationHistogram
+  {
+  public:
+    static const int numBuckets = 7;
+
+  private:
+    static const MLMicroSeconds bucketLimits[numBuckets];
+    uint64_t mBuckets[numBuckets]; ///< non-cumulative counts, last one is +Inf
+    uint64_t mCount;
+    MLMicroSeconds mSum;
+    MLMicroSeconds mMax;
+
+  public:
+    DurationHistogram() { reset(); }
+
+    void reset();
+
+    uint64_t count() const { return mCount; }
+    MLMicroSeconds sum() const { return mSum; }
+    MLMicroSeconds max() const { return mMax; }
+
+    void record(MLMicroSeconds aDuration);
+
+    /// append prometheus text exposition of this histogram
+    /// @param aText string to append to
+    /// @param aName metric name
+    /// @param aLabels label list (without braces), can be empty
+    void exposition(string &aText, const string aName, const string aLabels) const;
+  };
+
+
+  /// runtime metrics of p44featured, exposed in prometheus text format
+  class Metrics
+  {
+    typedef std::map<string, DurationHistogram> HistogramMap;
+
+    HistogramMap mApiLatencies; ///< API request latencies, by label string
+    HistogramMap mScriptTimes; ///< script execution times, by context name
+    HistogramMap mScriptAccounting; ///< script run totals since startup, by context name (not cleared by reset())
+    DurationHistogram mMainloopLateness; ///< how late a periodic mainloop timer fires
+    MLTicket mSampleTicket;
+    MLMicroSeconds mNextSample;
+    MLMicroSeconds mStarted;
+
+  public:
+
+    Metrics();
+
+    /// start sampling the mainloop
+    void start();
+
+    /// clear the histograms
+    /// @note script accounting as returned by scriptAccounting() is not affected
+    void reset();
+
+    /// @param aApi the API the request came in through (fixed set chosen by caller)
+    /// @param aUri the request URI, recorded as "other" when not a known route
+    /// @param aStarted when the request was received
+    void recordApiRequest(const string aApi, const string aUri, MLMicroSeconds aStarted);
+
+    /// @param aContext name of the script context (fixed set chosen by caller)
+    /// @param aStarted when the script was started
+    void recordScriptRun(const string aContext, MLMicroSeconds aStarted);
+
+    /// @return JSON object with run count, total and max elapsed (wall clock) time per script context since startup
+    /// @note elapsed time includes time the script was suspended in delay(), await() etc.
+    JsonObjectPtr scriptAccounting() const;
+
+    /// @param aRequestsPending number of currently pending API requests
+    /// @return metrics in prometheus text exposition format
+    string exposition(int aRequestsPending);
+
+  private:
+
+    void sampleMainloop(MLMicroSeconds aNow);
+
+  };
+
+} // namespace p44
+
+#endif // __p44featured__metrics__
@@ -0,0 +1,445 @@
+//
+//  Copyright (c) 2020 plan44.ch / Lukas Zeller, Zurich, Switzerland
+//
+//  Author: Lukas Zeller <luz@plan44.ch>
+//
+//  This file is part of p44featured.
+//
+//  p44featured is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  p44featured is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with p44featured. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "mgmtapi.hpp"
+
+#include "application.hpp"
+#include "extutils.hpp"
+
+#if ENABLE_P44SCRIPT
+  #include "httpcomm.hpp"
+#endif
+
+using namespace p44;
+
+
+#if ENABLE_P44SCRIPT
+
+// MARK: - ApiRequestObj
+
+class ApiRequestObj : public JsonValue
+{
+  typedef JsonValue inherited;
+
+  EventSource* mEventSource;
+  ApiRequestPtr mRequest;
+
+public:
+  ApiRequestObj(ApiRequestPtr aRequest, EventSource* aApiEventSource) :
+    inherited(aRequest ? aRequest->getRequest() : JsonObjectPtr()),
+    mRequest(aRequest),
+    mEventSource(aApiEventSource)
+  {
+  }
+
+  void sendResponse(JsonObjectPtr aResponse, ErrorPtr aError)
+  {
+    if (mRequest) mRequest->sendResponse(aResponse, aError);
+    mRequest.reset(); // done now
+  }
+
+  virtual string getAnnotation() const P44_OVERRIDE
+  {
+    return "API request";
+  }
+
+  virtual TypeInfo getTypeInfo() const P44_OVERRIDE
+  {
+    return inherited::getTypeInfo()|oneshot|keeporiginal; // returns the request only once, must keep the original
+  }
+
+  virtual EventSource *eventSource() const P44_OVERRIDE
+  {
+    return mEventSource;
+  }
+
+  virtual const ScriptObjPtr memberByName(const string aName, TypeInfo aMemberAccessFlags = none) P44_OVERRIDE;
+
+};
+
+// answer([answer value])        answer the request
+static const BuiltInArgDesc answer_args[] = { { any|optionalarg } };
+static const size_t answer_numargs = sizeof(answer_args)/sizeof(BuiltInArgDesc);
+static void answer_func(BuiltinFunctionContextPtr f)
+{
+  ApiRequestObj* reqObj = dynamic_cast<ApiRequestObj *>(f->thisObj().get());
+  if (f->arg(0)->isErr()) {
+    reqObj->sendResponse(JsonObjectPtr(), f->arg(0)->errorValue());
+  }
+  else {
+    reqObj->sendResponse(f->arg(0)->jsonValue(), ErrorPtr());
+  }
+  f->finish();
+}
+static const BuiltinMemberDescriptor answer_desc =
+  { "answer", executable|any, answer_numargs, answer_args, &answer_func };
+
+
+const ScriptObjPtr ApiRequestObj::memberByName(const string aName, TypeInfo aMemberAccessFlags)
+{
+  ScriptObjPtr val;
+  if (uequals(aName, "answer")) {
+    val = new BuiltinFunctionObj(&answer_desc, this, NULL);
+  }
+  else {
+    val = inherited::memberByName(aName, aMemberAccessFlags);
+  }
+  return val;
+}
+
+static ScriptApiLookup* scriptApiLookupP; // FIXME: ugly
+
+// webrequest()        return latest unprocessed script (web) api request
+static void webrequest_func(BuiltinFunctionContextPtr f);
+
+static const BuiltinMemberDescriptor scriptApiGlobals[] = {
+  { "webrequest", executable|json|null, 0, NULL, &webrequest_func },
+  { NULL } // terminator
+};
+
+
+ScriptApiLookup::ScriptApiLookup() :
+  inherited(scriptApiGlobals)
+{
+}
+
+
+static void webrequest_func(BuiltinFunctionContextPtr f)
+{
+  // return latest unprocessed API request
+  f->finish(new ApiRequestObj(scriptApiLookupP->pendingRequest(), scriptApiLookupP));
+}
+
+#endif // ENABLE_P44SCRIPT
+
+
+// MARK: - ManagementApi
+
+ManagementApi::ManagementApi() :
+  #if ENABLE_P44SCRIPT
+  mMainScript(sourcecode+regular, "main"),
+  mExecCodeMaxRunTime(Infinite),
+  #endif
+  mRequestsPending(0)
+{
+  #if ENABLE_P44SCRIPT
+  mScriptApiLookup.isMemberVariable();
+  StandardScriptingDomain::sharedDomain().registerMemberLookup(new FeatureApiLookup);
+  StandardScriptingDomain::sharedDomain().registerMemberLookup(&mScriptApiLookup);
+  scriptApiLookupP = &mScriptApiLookup; // FIXME: ugly static pointer
+  mMainScriptContext = StandardScriptingDomain::sharedDomain().newContext();
+  mMainScript.setSharedMainContext(mMainScriptContext);
+  // Add some extras
+  #if ENABLE_HTTP_SCRIPT_FUNCS
+  StandardScriptingDomain::sharedDomain().registerMemberLookup(new P44Script::HttpLookup);
+  #endif // ENABLE_HTTP_SCRIPT_FUNCS
+  #endif
+}
+
+
+#if ENABLE_P44SCRIPT
+
+ErrorPtr ManagementApi::loadMainScript(const string aFileName)
+{
+  mMainScriptFn = aFileName;
+  string code;
+  ErrorPtr err = string_fromfile(Application::sharedApplication()->dataPath(mMainScriptFn), code);
+  if (Error::notOK(err)) {
+    err = string_fromfile(Application::sharedApplication()->resourcePath(mMainScriptFn), code);
+  }
+  if (Error::isOK(err)) {
+    mMainScript.setSource(code);
+  }
+  return err;
+}
+
+
+void ManagementApi::startMainScript()
+{
+  mMainScript.run(stopall, boost::bind(&ManagementApi::mainScriptEndHandler, this, MainLoop::now(), _1));
+}
+
+
+void ManagementApi::restartMainScript()
+{
+  // Note: unlike the initial run, a restarted main script's result does not terminate the app
+  mMainScript.run(stopall, boost::bind(&ManagementApi::mainScriptRunDone, this, MainLoop::now(), _1));
+}
+
+
+void ManagementApi::mainScriptRunDone(MLMicroSeconds aStarted, ScriptObjPtr aResult)
+{
+  mMetrics.recordScriptRun("main", aStarted);
+}
+
+
+void ManagementApi::mainScriptEndHandler(MLMicroSeconds aStarted, ScriptObjPtr aMainScriptExitCode)
+{
+  mainScriptRunDone(aStarted, aMainScriptExitCode);
+  if (aMainScriptExitCode->hasType(numeric)) {
+    // use it as exit code
+    int exitCode = aMainScriptExitCode->intValue();
+    LOG(LOG_NOTICE, "main script completes with explicit exit code %d -> terminating", exitCode);
+    Application::sharedApplication()->terminateApp(exitCode);
+  }
+  else {
+    LOG(LOG_NOTICE, "main script completed w/o exit code");
+  }
+}
+
+#endif // ENABLE_P44SCRIPT
+
+
+// MARK: - mg44 style request decoding
+
+void ManagementApi::handleMg44Request(JsonObjectPtr aRequest, Mg44AnswerCB aAnswerCB)
+{
+  MLMicroSeconds started = MainLoop::now();
+  string uri;
+  ErrorPtr err;
+  mRequestsPending++;
+  LOG(LOG_INFO, "+++ New request pending, total now %d", mRequestsPending);
+  // Decode mg44-style request (HTTP wrapped in JSON)
+  LOG(LOG_INFO,"mg44 API request: %s", aRequest->c_strValue());
+  JsonObjectPtr o;
+  o = aRequest->get("method");
+  if (o) {
+    string method = o->stringValue();
+    o = aRequest->get("uri");
+    if (o) uri = o->stringValue();
+    JsonObjectPtr data;
+    bool upload = false;
+    bool action = (method!="GET");
+    // check for uploads
+    string uploadedfile;
+    if (aRequest->get("uploadedfile", o, true)) {
+      uploadedfile = o->stringValue();
+      upload = true;
+      action = false; // other params are in the URI, not the POSTed upload
+    }
+    if (action) {
+      // JSON data is in the request
+      data = aRequest->get("data");
+    }
+    else {
+      // URI params is the JSON to process
+      data = aRequest->get("uri_params");
+      if (!action && data) {
+        data->resetKeyIteration();
+        string k;
+        JsonObjectPtr v;
+        while (data->nextKeyValue(k, v)) {
+          if (k!="rqvaltok") {
+            // GET, but with query_params other than "rqvaltok": treat like PUT/POST with data
+            action = true;
+            break;
+          }
+        }
+      }
+      if (upload) {
+        // move that into the request
+        data->add("uploadedfile", JsonObject::newString(uploadedfile));
+      }
+    }
+    // request elements now: uri and data
+    if (processRequest(uri, data, action, boost::bind(&ManagementApi::mg44RequestDone, this, aAnswerCB, uri, started, _1, _2))) {
+      // done, callback will deliver the answer
+      return;
+    }
+    // request cannot be processed, return error
+    err = WebError::webErr(404, "No handler found for request to %s", uri.c_str());
+    LOG(LOG_ERR,"mg44 API: %s", err->description().c_str());
+  }
+  else {
+    err = WebError::webErr(415, "Invalid JSON request format");
+    LOG(LOG_ERR,"mg44 API: %s", err->description().c_str());
+  }
+  // return error
+  mg44RequestDone(aAnswerCB, uri, started, JsonObjectPtr(), err);
+}
+
+
+void ManagementApi::mg44RequestDone(Mg44AnswerCB aAnswerCB, const string aUri, MLMicroSeconds aStarted, JsonObjectPtr aResponse, ErrorPtr aError)
+{
+  mMetrics.recordApiRequest("mg44", aUri, aStarted);
+  mRequestsPending--;
+  LOG(LOG_INFO, "--- Request handled, remaining pending now %d", mRequestsPending);
+  if (!aResponse) {
+    aResponse = JsonObject::newObj(); // empty response
+  }
+  if (!Error::isOK(aError)) {
+    aResponse->add("error", JsonObject::newString(aError->description()));
+  }
+  LOG(LOG_INFO,"mg44 API answer: %s", aResponse->c_strValue());
+  if (aAnswerCB) aAnswerCB(aResponse);
+}
+
+
+// MARK: - request processing
+
+#if ENABLE_P44SCRIPT
+
+void ManagementApi::execCodeDone(RequestDoneCB aRequestDoneCB, MLMicroSeconds aStarted, ScriptObjPtr aResult)
+{
+  mMetrics.recordScriptRun("execcode", aStarted);
+  scriptExecHandler(aRequestDoneCB, aResult);
+}
+
+
+void ManagementApi::scriptExecHandler(RequestDoneCB aRequestDoneCB, ScriptObjPtr aResult)
+{
+  JsonObjectPtr ans = JsonObject::newObj();
+  if (aResult) {
+    if (aResult->isErr()) {
+      ans->add("error", ans->newString(aResult->errorValue()->text()));
+    }
+    else {
+      ans->add("result", aResult->jsonValue());
+    }
+    ans->add("annotation", JsonObject::newString(aResult->getAnnotation()));
+    SourceCursor *cursorP = aResult->cursor();
+    if (cursorP) {
+      ans->add("sourceline", JsonObject::newString(cursorP->linetext()));
+      ans->add("at", JsonObject::newInt64(cursorP->textpos()));
+      ans->add("line", JsonObject::newInt64(cursorP->lineno()));
+      ans->add("char", JsonObject::newInt64(cursorP->charpos()));
+    }
+  }
+  aRequestDoneCB(ans, ErrorPtr());
+}
+
+#endif // ENABLE_P44SCRIPT
+
+
+bool ManagementApi::processRequest(string aUri, JsonObjectPtr aData, bool aIsAction, RequestDoneCB aRequestDoneCB)
+{
+  ErrorPtr err;
+  JsonObjectPtr o;
+  if (aUri=="featureapi") {
+    // p44featured API wrapper
+    if (!aIsAction) {
+      aRequestDoneCB(JsonObjectPtr(), WebError::webErr(415, "p44featured API calls must be action-type (e.g. POST)"));
+      return true;
+    }
+    ApiRequestPtr req = ApiRequestPtr(new APICallbackRequest(aData, aRequestDoneCB));
+    FeatureApi::sharedApi()->handleRequest(req);
+    return true;
+  }
+  else if (aUri=="metrics") {
+    if (aIsAction && aData && aData->get("reset", o) && o->boolValue()) {
+      mMetrics.reset();
+    }
+    // prometheus text exposition, wrapped in JSON
+    JsonObjectPtr ans = JsonObject::newObj();
+    ans->add("text", JsonObject::newString(metricsExposition()));
+    aRequestDoneCB(ans, ErrorPtr());
+    return true;
+  }
+  else if (aUri=="log") {
+    if (aIsAction) {
+      if (aData->get("level", o, true)) {
+        int oldLevel = LOGLEVEL;
+        SETLOGLEVEL(o->int32Value());
+        LOG(LOGLEVEL, "\n==== changed log level from %d to %d ====\n", oldLevel, LOGLEVEL);
+        aRequestDoneCB(JsonObjectPtr(), ErrorPtr());
+        return true;
+      }
+    }
+  }
+  #if ENABLE_P44SCRIPT
+  else if (aUri=="mainscript") {
+    if (aData->get("execcode", o)) {
+      // direct execution of a script command line in the common main/initscript context
+      ScriptSource src(sourcecode+regular+keepvars+concurrently+floatingGlobs, "execcode");
+      src.setSource(o->stringValue());
+      src.setSharedMainContext(mMainScriptContext);
+      MLMicroSeconds maxRunTime = mExecCodeMaxRunTime;
+      if (aData->get("maxruntime", o)) {
+        // per-request run time limit in milliseconds (same unit as execcodemaxtime), can only shorten the configured limit
+        double ms = o->doubleValue();
+        if (!(ms>0)) {
+          aRequestDoneCB(JsonObjectPtr(), WebError::webErr(400, "maxruntime must be >0"));
+          return true;
+        }
+        // compare before converting, so huge values cannot overflow MLMicroSeconds
+        if (ms<(double)maxRunTime/MilliSecond) maxRunTime = ms*MilliSecond;
+      }
+      src.run(inherit, boost::bind(&ManagementApi::execCodeDone, this, aRequestDoneCB, MainLoop::now(), _1), maxRunTime);
+      return true;
+    }
+    bool newCode = false;
+    if (aData->get("stop", o) && o->boolValue()) {
+      // stop
+      mMainScriptContext->abort(stopall);
+    }
+    if (aIsAction && aData->get("code", o)) {
+      // set new main script
+      mMainScriptContext->abort(stopall);
+      mMainScript.setSource(o->stringValue());
+      // always: check it
+      ScriptObjPtr res = mMainScript.syntaxcheck();
+      ErrorPtr err;
+      if (!res || !res->isErr()) {
+        LOG(LOG_INFO, "Checked global main script: syntax OK");
+        if (aData->get("save", o) && o->boolValue()) {
+          // save the script
+          err = string_tofile(Application::sharedApplication()->dataPath(mMainScriptFn), mMainScript.getSource());
+        }
+      }
+      else {
+        LOG(LOG_NOTICE, "Error in global main script: %s", res->errorValue()->text());
+        scriptExecHandler(aRequestDoneCB, res);
+        return true;
+      }
+      newCode = true;
+      // checked ok
+    }
+    if (aData->get("run", o) && o->boolValue()) {
+      // run the script
+      LOG(LOG_NOTICE, "Re-starting global main script");
+      restartMainScript();
+    }
+    else if (!newCode) {
+      // return current mainscript code
+      JsonObjectPtr codeResult = JsonObject::newObj();
+      codeResult->add("code", JsonObject::newString(mMainScript.getSource()));
+      codeResult->add("accounting", mMetrics.scriptAccounting());
+      aRequestDoneCB(codeResult, ErrorPtr());
+      return true;
+    }
+    // ok w/o result
+    aRequestDoneCB(JsonObjectPtr(), err);
+    return true;
+  }
+  else if (aUri=="scriptapi") {
+    // scripted parts of the (web) API
+    if (!mScriptApiLookup.hasSinks()) {
+      // no script API active
+      aRequestDoneCB(JsonObjectPtr(), WebError::webErr(500, "script API not active"));
+      return true;
+    }
+    mScriptApiLookup.mPendingScriptApiRequest = ApiRequestPtr(new APICallbackRequest(aData, aRequestDoneCB));
+    mScriptApiLookup.sendEvent(new ApiRequestObj(mScriptApiLookup.mPendingScriptApiRequest, &mScriptApiLookup));
+    return true;
+  }
+  #endif
+  return false;
+}
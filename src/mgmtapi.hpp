@@ -0,0 +1,129 @@
+//
+//  Copyright (c) 2020 plan44.ch / Lukas Zeller, Zurich, Switzerland
+//
+//  Author: Lukas Zeller <luz@plan44.ch>
+//
+//  This file is part of p44featured.
+//
+//  p44featured is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  p44featured is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with p44featured. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __p44featured__mgmtapi__
+#define __p44featured__mgmtapi__
+
+#include "p44utils_common.hpp"
+#include "featureapi.hpp"
+#include "p44script.hpp"
+#include "metrics.hpp"
+
+using namespace std;
+
+namespace p44 {
+
+  /// callback delivering the complete answer to a mg44 style request
+  typedef boost::function<void (JsonObjectPtr aAnswer)> Mg44AnswerCB;
+
+  #if ENABLE_P44SCRIPT
+
+  /// represents the global objects related to the script (web) API
+  class ScriptApiLookup : public BuiltInMemberLookup, public EventSource
+  {
+    typedef BuiltInMemberLookup inherited;
+    friend class ManagementApi;
+
+    ApiRequestPtr mPendingScriptApiRequest; ///< pending script API request
+
+  public:
+    ScriptApiLookup();
+
+    ApiRequestPtr pendingRequest()
+    {
+      ApiRequestPtr r = mPendingScriptApiRequest;
+      mPendingScriptApiRequest.reset();
+      return r;
+    }
+
+  };
+
+  #endif // ENABLE_P44SCRIPT
+
+
+  /// the management/web API of p44featured, as accessed via mg44 style JSON or ubus
+  class ManagementApi
+  {
+    #if ENABLE_P44SCRIPT
+    string mMainScriptFn; ///< filename for the main script
+    ScriptSource mMainScript; ///< global main script
+    ScriptMainContextPtr mMainScriptContext; ///< context for global vdc scripts
+    ScriptApiLookup mScriptApiLookup; ///< lookup and event source for script API
+    MLMicroSeconds mExecCodeMaxRunTime; ///< max run time for execcode snippets
+    #endif
+
+    int mRequestsPending; ///< number of requests not yet answered
+    Metrics mMetrics; ///< runtime metrics
+
+  public:
+
+    ManagementApi();
+
+    Metrics& metrics() { return mMetrics; }
+
+    /// @return current metrics in prometheus text exposition format
+    string metricsExposition() { return mMetrics.exposition(mRequestsPending); }
+
+    #if ENABLE_P44SCRIPT
+
+    /// load the main script from data or resource path
+    /// @param aFileName file name of the main script, will also be used to save it
+    ErrorPtr loadMainScript(const string aFileName);
+
+    /// @param aMaxRunTime max run time for execcode snippets, requests can only shorten it
+    void setExecCodeMaxRunTime(MLMicroSeconds aMaxRunTime) { mExecCodeMaxRunTime = aMaxRunTime; };
+
+    /// start the main script at application startup
+    /// @note a numeric result of this run terminates the application with that exit code
+    void startMainScript();
+
+    #endif // ENABLE_P44SCRIPT
+
+    /// handle a mg44-style request (HTTP wrapped in JSON)
+    /// @param aRequest the request as sent by mg44
+    /// @param aAnswerCB will be called with the answer to send back to mg44
+    void handleMg44Request(JsonObjectPtr aRequest, Mg44AnswerCB aAnswerCB);
+
+    /// process a decoded API request
+    /// @param aUri the API route
+    /// @param aData the request data
+    /// @param aIsAction set if request is an action (POST/PUT or GET with parameters)
+    /// @param aRequestDoneCB will be called with the result
+    /// @return false if no handler was found for aUri (aRequestDoneCB is not called then)
+    bool processRequest(string aUri, JsonObjectPtr aData, bool aIsAction, RequestDoneCB aRequestDoneCB);
+
+  private:
+
+    void mg44RequestDone(Mg44AnswerCB aAnswerCB, const string aUri, MLMicroSeconds aStarted, JsonObjectPtr aResponse, ErrorPtr aError);
+
+    #if ENABLE_P44SCRIPT
+    void restartMainScript();
+    void mainScriptEndHandler(MLMicroSeconds aStarted, ScriptObjPtr aMainScriptExitCode);
+    void mainScriptRunDone(MLMicroSeconds aStarted, ScriptObjPtr aResult);
+    void execCodeDone(RequestDoneCB aRequestDoneCB, MLMicroSeconds aStarted, ScriptObjPtr aResult);
+    void scriptExecHandler(RequestDoneCB aRequestDoneCB, ScriptObjPtr aResult);
+    #endif
+
+  };
+
+} // namespace p44
+
+#endif // __p44featured__mgmtapi__
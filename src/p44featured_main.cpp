@@ -39,10 +39,6 @@
 #include "rfids.hpp"
 #include "splitflaps.hpp"
 
-#if ENABLE_P44SCRIPT
-  #include "httpcomm.hpp"
-#endif
-
 #if ENABLE_LEDARRANGEMENT
   #include "viewfactory.hpp"
 #endif
@@ -51,6 +47,8 @@
   #include "ubus.hpp"
 #endif
 
+#include "mgmtapi.hpp"
+
 
 using namespace p44;
 
@@ -71,122 +69,6 @@ static const struct blobmsg_policy p44featureapi_policy[] = {
 #endif
 
 
-#if ENABLE_P44SCRIPT
-
-// MARK: - ApiRequestObj
-
-class ApiRequestObj : public JsonValue
-{
-  typedef JsonValue inherited;
-
-  EventSource* mEventSource;
-  ApiRequestPtr mRequest;
-
-public:
-  ApiRequestObj(ApiRequestPtr aRequest, EventSource* aApiEventSource) :
-    inherited(aRequest ? aRequest->getRequest() : JsonObjectPtr()),
-    mRequest(aRequest),
-    mEventSource(aApiEventSource)
-  {
-  }
-
-  void sendResponse(JsonObjectPtr aResponse, ErrorPtr aError)
-  {
-    if (mRequest) mRequest->sendResponse(aResponse, aError);
-    mRequest.reset(); // done now
-  }
-
-  virtual string getAnnotation() const P44_OVERRIDE
-  {
-    return "API request";
-  }
-
-  virtual TypeInfo getTypeInfo() const P44_OVERRIDE
-  {
-    return inherited::getTypeInfo()|oneshot|keeporiginal; // returns the request only once, must keep the original
-  }
-
-  virtual EventSource *eventSource() const P44_OVERRIDE
-  {
-    return mEventSource;
-  }
-
-  virtual const ScriptObjPtr memberByName(const string aName, TypeInfo aMemberAccessFlags = none) P44_OVERRIDE;
-
-};
-
-// answer([answer value])        answer the request
-static const BuiltInArgDesc answer_args[] = { { any|optionalarg } };
-static const size_t answer_numargs = sizeof(answer_args)/sizeof(BuiltInArgDesc);
-static void answer_func(BuiltinFunctionContextPtr f)
-{
-  ApiRequestObj* reqObj = dynamic_cast<ApiRequestObj *>(f->thisObj().get());
-  if (f->arg(0)->isErr()) {
-    reqObj->sendResponse(JsonObjectPtr(), f->arg(0)->errorValue());
-  }
-  else {
-    reqObj->sendResponse(f->arg(0)->jsonValue(), ErrorPtr());
-  }
-  f->finish();
-}
-static const BuiltinMemberDescriptor answer_desc =
-  { "answer", executable|any, answer_numargs, answer_args, &answer_func };
-
-
-const ScriptObjPtr ApiRequestObj::memberByName(const string aName, TypeInfo aMemberAccessFlags)
-{
-  ScriptObjPtr val;
-  if (uequals(aName, "answer")) {
-    val = new BuiltinFunctionObj(&answer_desc, this, NULL);
-  }
-  else {
-    val = inherited::memberByName(aName, aMemberAccessFlags);
-  }
-  return val;
-}
-
-class ScriptApiLookup;
-
-static ScriptApiLookup* scriptApiLookupP; // FIXME: ugly
-
-// webrequest()        return latest unprocessed script (web) api request
-static void webrequest_func(BuiltinFunctionContextPtr f);
-
-static const BuiltinMemberDescriptor scriptApiGlobals[] = {
-  { "webrequest", executable|json|null, 0, NULL, &webrequest_func },
-  { NULL } // terminator
-};
-
-/// represents the global objects related to p44features
-class ScriptApiLookup : public BuiltInMemberLookup, public EventSource
-{
-  typedef BuiltInMemberLookup inherited;
-  friend class P44FeatureD;
-
-  ApiRequestPtr mPendingScriptApiRequest; ///< pending script API request
-
-public:
-  ScriptApiLookup() : inherited(scriptApiGlobals) {};
-
-  ApiRequestPtr pendingRequest()
-  {
-    ApiRequestPtr r = mPendingScriptApiRequest;
-    mPendingScriptApiRequest.reset();
-    return r;
-  }
-
-};
-
-
-static void webrequest_func(BuiltinFunctionContextPtr f)
-{
-  // return latest unprocessed API request
-  f->finish(new ApiRequestObj(scriptApiLookupP->pendingRequest(), scriptApiLookupP));
-}
-
-
-#endif // ENABLE_P44SCRIPT
-
 // MARK: ==== Application
 
 #define MKSTR(s) _MKSTR(s)
@@ -199,7 +81,12 @@ class P44FeatureD : public CmdLineApp
 
   // P44 device management JSON API Server
   SocketCommPtr p44mgmtApiServer;
-  int requestsPending;
+  ManagementApi mgmtApi;
+
+  // startup timing
+  MLMicroSeconds startupBegin; ///< when the app object was created
+  MLMicroSeconds startupStepBegin; ///< begin of the current startup step
+  string startupTimings; ///< startup timing breakdown
 
   #if ENABLE_UBUS
   // ubus API for P44 device management
@@ -210,13 +97,6 @@ class P44FeatureD : public CmdLineApp
   LEDChainArrangementPtr ledChainArrangement;
   #endif
 
-  #if ENABLE_P44SCRIPT
-  string mainScriptFn; ///< filename for the main script
-  ScriptSource mainScript; ///< global main script
-  ScriptMainContextPtr mainScriptContext; ///< context for global vdc scripts
-  ScriptApiLookup scriptApiLookup; ///< lookup and event source for script API
-  #endif
-
   // LED+Button
   ButtonInputPtr button;
   IndicatorOutputPtr greenLed;
@@ -245,26 +125,21 @@ class P44FeatureD : public CmdLineApp
 public:
 
   P44FeatureD() :
-    #if ENABLE_P44SCRIPT
-    mainScript(sourcecode+regular, "main"),
-    #endif
-    requestsPending(0),
     selectedReader(RFID522::Deselect)
   {
-    #if ENABLE_P44SCRIPT
-    scriptApiLookup.isMemberVariable();
-    StandardScriptingDomain::sharedDomain().registerMemberLookup(new FeatureApiLookup);
-    StandardScriptingDomain::sharedDomain().registerMemberLookup(&scriptApiLookup);
-    scriptApiLookupP = &scriptApiLookup; // FIXME: ugly static pointer
-    mainScriptContext = StandardScriptingDomain::sharedDomain().newContext();
-    mainScript.setSharedMainContext(mainScriptContext);
-    // Add some extras
-    #if ENABLE_HTTP_SCRIPT_FUNCS
-    StandardScriptingDomain::sharedDomain().registerMemberLookup(new P44Script::HttpLookup);
-    #endif // ENABLE_HTTP_SCRIPT_FUNCS
-    #endif
+    startupBegin = MainLoop::now();
+    startupStepBegin = startupBegin;
   }
 
+  /// record the time spent since the previous startup step
+  void startupStep(const char *aStepName)
+  {
+    MLMicroSeconds now = MainLoop::now();
+    string_format_append(startupTimings, "%s%s=%lld", startupTimings.empty() ? "" : ", ", aStepName, (long long)((now-startupStepBegin)/MilliSecond));
+    startupStepBegin = now;
+  }
+
+
   virtual bool processOption(const CmdLineOptionDescriptor &aOptionDescriptor, const char *aOptionValue)
   {
     #if ENABLE_LEDARRANGEMENT
@@ -340,6 +215,7 @@ public:
       #endif
       #if ENABLE_P44SCRIPT
       { 0  , "mainscript",     true,  "p44scriptfile;the main script to run after startup" },
+      { 0  , "execcodemaxtime",true,  "milliseconds;default max run time for execcode snippets (default=unlimited)" },
       #endif
       { 0  , "featuretool",    true,  "feature;start a feature's command line tool" },
       { 0  , "jsonapiport",    true,  "port;server port number for management/web JSON API (default=none)" },
@@ -376,6 +252,7 @@ public:
       getIntOption("errlevel", errlevel);
       SETERRLEVEL(errlevel, !getOption("dontlogerrors"));
       SETDELTATIME(getOption("deltatstamps"));
+      startupStep("options");
 
       // create button input
       button = ButtonInputPtr(new ButtonInput(getOption("button","missing")));
@@ -396,6 +273,7 @@ public:
         #endif
       }
       #endif
+      startupStep("io");
 
       // create API
       featureApi = FeatureApi::sharedApi();
@@ -406,12 +284,14 @@ public:
       featureApi->addFeature(FeaturePtr(new Light(
         pwmDimmer
       )));
+      startupStep("light");
       #endif
       #if ENABLE_FEATURE_INPUTS
       // - inputs (instantiate only with command line option, as it allows free use of GPIOs etc.)
       if (getOption("inputs")) {
         featureApi->addFeature(FeaturePtr(new Inputs));
       }
+      startupStep("inputs");
       #endif
       #if ENABLE_FEATURE_HERMEL
       // - hermel
@@ -420,6 +300,7 @@ public:
       featureApi->addFeature(FeaturePtr(new HermelShoot(
         pwmLeft, pwmRight
       )));
+      startupStep("hermel");
       #endif
       #if ENABLE_FEATURE_MIXLOOP
       // - mixloop
@@ -427,12 +308,14 @@ public:
         getOption("ledchain2","/dev/null"),
         getOption("ledchain3","/dev/null")
       )));
+      startupStep("mixloop");
       #endif
       #if ENABLE_FEATURE_WIFITRACK
       // - wifitrack
       featureApi->addFeature(FeaturePtr(new WifiTrack(
         getOption("wifimonif","")
       )));
+      startupStep("wifitrack");
       #endif
       #if ENABLE_FEATURE_NEURON
       // - neuron
@@ -442,14 +325,17 @@ public:
         getOption("ledchain2","/dev/null"),
         sensor0
       )));
+      startupStep("neuron");
       #endif
       #if ENABLE_FEATURE_DISPMATRIX
       // - dispmatrix
       featureApi->addFeature(FeaturePtr(new DispMatrix(ledChainArrangement)));
+      startupStep("dispmatrix");
       #endif
       #if ENABLE_FEATURE_INDICATORS
       // - indicators
       featureApi->addFeature(FeaturePtr(new Indicators(ledChainArrangement)));
+      startupStep("indicators");
       #endif
       #if ENABLE_FEATURE_RFIDS
       // - RFIDs
@@ -481,6 +367,7 @@ public:
           irqPin
         )));
       }
+      startupStep("rfids");
       #endif // ENABLE_FEATURE_RFIDS
       #if ENABLE_FEATURE_SPLITFLAPS
       string s;
@@ -496,6 +383,7 @@ public:
           tx.c_str(), rx.c_str(), txoffdelay
         )));
       }
+      startupStep("splitflaps");
       #endif // ENABLE_FEATURE_SPLITFLAPS
       // use feature tools, if specified
       string featuretool;
@@ -508,6 +396,18 @@ public:
           terminateAppWith(TextError::err("No feature '%s' exists", featuretool.c_str()));
         }
       }
+      #if ENABLE_P44SCRIPT
+      // execcode run time limit, checked before anything gets started
+      int maxms;
+      if (getIntOption("execcodemaxtime", maxms)) {
+        if (maxms<=0) {
+          terminateAppWith(TextError::err("execcodemaxtime must be >0"));
+        }
+        else {
+          mgmtApi.setExecCodeMaxRunTime(maxms*MilliSecond);
+        }
+      }
+      #endif
       if (!isTerminated()) {
         // run the initialisation command file
         #if ENABLE_LEGACY_FEATURE_SCRIPTS
@@ -517,6 +417,7 @@ public:
           if (!Error::isOK(err)) {
             terminateAppWith(err);
           }
+          startupStep("initjson");
         }
         #endif
         #if EXPRESSION_JSON_SUPPORT
@@ -530,22 +431,18 @@ public:
           else {
             featureApi->queueScript("initscript", initScript);
           }
+          startupStep("initscript");
         }
         #endif
         #if ENABLE_P44SCRIPT
+        string mainScriptFn;
         if (getStringOption("mainscript", mainScriptFn)) {
-          string code;
-          ErrorPtr err = string_fromfile(dataPath(mainScriptFn), code);
+          ErrorPtr err = mgmtApi.loadMainScript(mainScriptFn);
           if (Error::notOK(err)) {
-            err = string_fromfile(resourcePath(mainScriptFn), code);
-            if (Error::notOK(err)) {
-              LOG(LOG_ERR,"cannot open mainscript '%s': %s", mainScriptFn.c_str(), err->text());
-            }
-          }
-          if (Error::isOK(err)) {
-            mainScript.setSource(code);
+            LOG(LOG_ERR,"cannot open mainscript '%s': %s", mainScriptFn.c_str(), err->text());
           }
         }
+        startupStep("mainscriptload");
         #endif
         // start p44featured TCP API server
         string apiport;
@@ -566,6 +463,7 @@ public:
           initUbusApi();
         }
         #endif
+        startupStep("apis");
       } // if !terminated
     } // if !terminated
     // app now ready to run (or cleanup when already terminated)
@@ -574,33 +472,24 @@ public:
 
   virtual void initialize()
   {
+    startupStep("mainloopstart");
     LOG(LOG_NOTICE, "p44featured initialize()");
+    mgmtApi.metrics().start();
     #if ENABLE_UBUS
     // start ubus API, if we have it
     if (ubusApiServer) {
       ubusApiServer->startServer();
       LOG(LOG_INFO, "ubus server started");
+      startupStep("ubusstart");
     }
     #endif
     #if ENABLE_P44SCRIPT
     LOG(LOG_INFO, "starting main script");
-    mainScript.run(stopall, boost::bind(&P44FeatureD::mainScriptEndHandler, this, _1));
+    mgmtApi.startMainScript();
     LOG(LOG_INFO, "main script started");
+    startupStep("mainscriptstart");
     #endif
-  }
-
-
-  void mainScriptEndHandler(ScriptObjPtr aMainScriptExitCode)
-  {
-    if (aMainScriptExitCode->hasType(numeric)) {
-      // use it as exit code
-      int exitCode = aMainScriptExitCode->intValue();
-      LOG(LOG_NOTICE, "main script completes with explicit exit code %d -> terminating", exitCode);
-      terminateApp(exitCode);
-    }
-    else {
-      LOG(LOG_NOTICE, "main script completed w/o exit code");
-    }
+    LOG(LOG_NOTICE, "startup took %lld mS: %s", (long long)((MainLoop::now()-startupBegin)/MilliSecond), startupTimings.c_str());
   }
 
 
@@ -645,6 +534,7 @@ public:
     UbusObjectPtr u = new UbusObject("p44featured", boost::bind(&P44FeatureD::ubusApiRequestHandler, this, _1, _2, _3));
     u->addMethod("log", logapi_policy);
     u->addMethod("featureapi", p44featureapi_policy);
+    u->addMethod("metrics");
     u->addMethod("quit");
     ubusApiServer->registerObject(u);
   }
@@ -671,20 +561,25 @@ public:
       terminateApp(1);
       aUbusRequest->sendResponse(JsonObjectPtr());
     }
+    else if (aMethod=="metrics") {
+      JsonObjectPtr response = JsonObject::newObj();
+      response->add("text", JsonObject::newString(mgmtApi.metricsExposition()));
+      aUbusRequest->sendResponse(response);
+    }
     else if (aMethod=="featureapi") {
       ErrorPtr err;
       JsonObjectPtr result;
       if (aJsonRequest) {
         // run on featureAPI
         LOG(LOG_INFO,"ubus feature API request: %s", aJsonRequest->c_strValue());
-        ApiRequestPtr req = ApiRequestPtr(new APICallbackRequest(aJsonRequest, boost::bind(&P44FeatureD::ubusFeatureApiRequestDone, this, aUbusRequest, _1, _2)));
+        ApiRequestPtr req = ApiRequestPtr(new APICallbackRequest(aJsonRequest, boost::bind(&P44FeatureD::ubusFeatureApiRequestDone, this, aUbusRequest, MainLoop::now(), _1, _2)));
         featureApi->handleRequest(req);
         return;
       }
       else {
         err = TextError::err("missing API command object");
       }
-      ubusFeatureApiRequestDone(aUbusRequest, result, err);
+      ubusFeatureApiRequestDone(aUbusRequest, MainLoop::now(), result, err);
     }
     else {
       // no other methods implemented yet
@@ -692,8 +587,9 @@ public:
     }
   }
 
-  void ubusFeatureApiRequestDone(UbusRequestPtr aUbusRequest, JsonObjectPtr aResult, ErrorPtr aError)
+  void ubusFeatureApiRequestDone(UbusRequestPtr aUbusRequest, MLMicroSeconds aStarted, JsonObjectPtr aResult, ErrorPtr aError)
   {
+    mgmtApi.metrics().recordApiRequest("ubus", "featureapi", aStarted);
     JsonObjectPtr response = JsonObject::newObj();
     if (aResult) response->add("result", aResult);
     if (aError) response->add("error", JsonObject::newString(aError->description()));
@@ -720,207 +616,24 @@ public:
 
   void apiRequestHandler(JsonCommPtr aConnection, ErrorPtr aError, JsonObjectPtr aRequest)
   {
-    // Decode mg44-style request (HTTP wrapped in JSON)
     if (Error::isOK(aError)) {
-      LOG(LOG_INFO,"mg44 API request: %s", aRequest->c_strValue());
-      JsonObjectPtr o;
-      o = aRequest->get("method");
-      if (o) {
-        string method = o->stringValue();
-        string uri;
-        o = aRequest->get("uri");
-        if (o) uri = o->stringValue();
-        JsonObjectPtr data;
-        bool upload = false;
-        bool action = (method!="GET");
-        // check for uploads
-        string uploadedfile;
-        if (aRequest->get("uploadedfile", o, true)) {
-          uploadedfile = o->stringValue();
-          upload = true;
-          action = false; // other params are in the URI, not the POSTed upload
-        }
-        if (action) {
-          // JSON data is in the request
-          data = aRequest->get("data");
-        }
-        else {
-          // URI params is the JSON to process
-          data = aRequest->get("uri_params");
-          if (!action && data) {
-            data->resetKeyIteration();
-            string k;
-            JsonObjectPtr v;
-            while (data->nextKeyValue(k, v)) {
-              if (k!="rqvaltok") {
-                // GET, but with query_params other than "rqvaltok": treat like PUT/POST with data
-                action = true;
-                break;
-              }
-            }
-          }
-          if (upload) {
-            // move that into the request
-            data->add("uploadedfile", JsonObject::newString(uploadedfile));
-          }
-        }
-        // request elements now: uri and data
-        requestsPending++;
-        LOG(LOG_INFO, "+++ New request pending, total now %d", requestsPending);
-        if (processRequest(uri, data, action, boost::bind(&P44FeatureD::requestHandled, this, aConnection, _1, _2))) {
-          // done, callback will send response and close connection
-          return;
-        }
-        LOG(LOG_INFO, "--- Request handled, remaining pending now %d", requestsPending-1);
-        // request cannot be processed, return error
-        aError = WebError::webErr(404, "No handler found for request to %s", uri.c_str());
-        LOG(LOG_ERR,"mg44 API: %s", aError->description().c_str());
-      }
-      else {
-        aError = WebError::webErr(415, "Invalid JSON request format");
-        LOG(LOG_ERR,"mg44 API: %s", aError->description().c_str());
-      }
+      mgmtApi.handleMg44Request(aRequest, boost::bind(&P44FeatureD::sendApiAnswer, this, aConnection, _1));
+      return;
     }
     // return error
-    requestHandled(aConnection, JsonObjectPtr(), aError);
+    JsonObjectPtr answer = JsonObject::newObj();
+    answer->add("error", JsonObject::newString(aError->description()));
+    sendApiAnswer(aConnection, answer);
   }
 
 
-  void requestHandled(JsonCommPtr aConnection, JsonObjectPtr aResponse, ErrorPtr aError)
+  void sendApiAnswer(JsonCommPtr aConnection, JsonObjectPtr aAnswer)
   {
-    requestsPending--;
-    LOG(LOG_INFO, "--- Request handled, remaining pending now %d", requestsPending);
-    if (!aResponse) {
-      aResponse = JsonObject::newObj(); // empty response
-    }
-    if (!Error::isOK(aError)) {
-      aResponse->add("error", JsonObject::newString(aError->description()));
-    }
-    LOG(LOG_INFO,"mg44 API answer: %s", aResponse->c_strValue());
-    aConnection->sendMessage(aResponse);
+    aConnection->sendMessage(aAnswer);
     aConnection->closeAfterSend();
   }
 
 
-  #if ENABLE_P44SCRIPT
-  void scriptExecHandler(RequestDoneCB aRequestDoneCB, ScriptObjPtr aResult)
-  {
-    JsonObjectPtr ans = JsonObject::newObj();
-    if (aResult) {
-      if (aResult->isErr()) {
-        ans->add("error", ans->newString(aResult->errorValue()->text()));
-      }
-      else {
-        ans->add("result", aResult->jsonValue());
-      }
-      ans->add("annotation", JsonObject::newString(aResult->getAnnotation()));
-      SourceCursor *cursorP = aResult->cursor();
-      if (cursorP) {
-        ans->add("sourceline", JsonObject::newString(cursorP->linetext()));
-        ans->add("at", JsonObject::newInt64(cursorP->textpos()));
-        ans->add("line", JsonObject::newInt64(cursorP->lineno()));
-        ans->add("char", JsonObject::newInt64(cursorP->charpos()));
-      }
-    }
-    aRequestDoneCB(ans, ErrorPtr());
-  }
-  #endif
-
-
-  bool processRequest(string aUri, JsonObjectPtr aData, bool aIsAction, RequestDoneCB aRequestDoneCB)
-  {
-    ErrorPtr err;
-    JsonObjectPtr o;
-    if (aUri=="featureapi") {
-      // p44featured API wrapper
-      if (!aIsAction) {
-        aRequestDoneCB(JsonObjectPtr(), WebError::webErr(415, "p44featured API calls must be action-type (e.g. POST)"));
-        return true;
-      }
-      ApiRequestPtr req = ApiRequestPtr(new APICallbackRequest(aData, aRequestDoneCB));
-      featureApi->handleRequest(req);
-      return true;
-    }
-    else if (aUri=="log") {
-      if (aIsAction) {
-        if (aData->get("level", o, true)) {
-          int oldLevel = LOGLEVEL;
-          SETLOGLEVEL(o->int32Value());
-          LOG(LOGLEVEL, "\n==== changed log level from %d to %d ====\n", oldLevel, LOGLEVEL);
-          aRequestDoneCB(JsonObjectPtr(), ErrorPtr());
-          return true;
-        }
-      }
-    }
-    #if ENABLE_P44SCRIPT
-    else if (aUri=="mainscript") {
-      if (aData->get("execcode", o)) {
-        // direct execution of a script command line in the common main/initscript context
-        ScriptSource src(sourcecode+regular+keepvars+concurrently+floatingGlobs, "execcode");
-        src.setSource(o->stringValue());
-        src.setSharedMainContext(mainScriptContext);
-        src.run(inherit, boost::bind(&P44FeatureD::scriptExecHandler, this, aRequestDoneCB, _1));
-        return true;
-      }
-      bool newCode = false;
-      if (aData->get("stop", o) && o->boolValue()) {
-        // stop
-        mainScriptContext->abort(stopall);
-      }
-      if (aIsAction && aData->get("code", o)) {
-        // set new main script
-        mainScriptContext->abort(stopall);
-        mainScript.setSource(o->stringValue());
-        // always: check it
-        ScriptObjPtr res = mainScript.syntaxcheck();
-        ErrorPtr err;
-        if (!res || !res->isErr()) {
-          LOG(LOG_INFO, "Checked global main script: syntax OK");
-          if (aData->get("save", o) && o->boolValue()) {
-            // save the script
-            err = string_tofile(dataPath(mainScriptFn), mainScript.getSource());
-          }
-        }
-        else {
-          LOG(LOG_NOTICE, "Error in global main script: %s", res->errorValue()->text());
-          scriptExecHandler(aRequestDoneCB, res);
-          return true;
-        }
-        newCode = true;
-        // checked ok
-      }
-      if (aData->get("run", o) && o->boolValue()) {
-        // run the script
-        LOG(LOG_NOTICE, "Re-starting global main script");
-        mainScript.run(stopall);
-      }
-      else if (!newCode) {
-        // return current mainscript code
-        JsonObjectPtr codeResult = JsonObject::newObj();
-        codeResult->add("code", JsonObject::newString(mainScript.getSource()));
-        aRequestDoneCB(codeResult, ErrorPtr());
-        return true;
-      }
-      // ok w/o result
-      aRequestDoneCB(JsonObjectPtr(), err);
-      return true;
-    }
-    else if (aUri=="scriptapi") {
-      // scripted parts of the (web) API
-      if (!scriptApiLookup.hasSinks()) {
-        // no script API active
-        aRequestDoneCB(JsonObjectPtr(), WebError::webErr(500, "script API not active"));
-        return true;
-      }
-      scriptApiLookup.mPendingScriptApiRequest = ApiRequestPtr(new APICallbackRequest(aData, aRequestDoneCB));
-      scriptApiLookup.sendEvent(new ApiRequestObj(scriptApiLookup.mPendingScriptApiRequest, &scriptApiLookup));
-      return true;
-    }
-    #endif
-    return false;
-  }
-
-
   ErrorPtr processUpload(string aUri, JsonObjectPtr aData, const string aUploadedFile)
   {
     ErrorPtr err;
@@ -0,0 +1,200 @@
+//
+//  Copyright (c) 2020 plan44.ch / Lukas Zeller, Zurich, Switzerland
+//
+//  Author: Lukas Zeller <luz@plan44.ch>
+//
+//  This file is part of p44featured.
+//
+//  p44featured is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  p44featured is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with p44featured. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "catch.hpp"
+
+#include "benchmark.hpp"
+
+#include "mgmtapi.hpp"
+#include "featureapi.hpp"
+#include "analogio.hpp"
+#include "light.hpp"
+#include "p44script.hpp"
+
+#if ENABLE_LEDARRANGEMENT
+  #include "ledchaincomm.hpp"
+  #include "viewfactory.hpp"
+#endif
+
+using namespace p44;
+using namespace P44Script;
+
+
+// MARK: - fixture
+
+/// management API and FeatureApi with a representative feature, shared by all benchmarks
+static ManagementApi& benchMgmtApi()
+{
+  static ManagementApi* mgmtApiP = NULL;
+  if (!mgmtApiP) {
+    mgmtApiP = new ManagementApi;
+    #if ENABLE_FEATURE_LIGHT
+    // light on a dummy PWM output, as p44featured creates it without pwmdimmer option
+    FeatureApi::sharedApi()->addFeature(FeaturePtr(new Light(
+      AnalogIoPtr(new AnalogIo("missing", true, 0))
+    )));
+    #endif
+  }
+  return *mgmtApiP;
+}
+
+
+// MARK: - JSON API
+
+// a typical mg44 style request as sent by the web frontend
+static const char *mg44Request =
+  "{\"method\":\"POST\",\"uri\":\"featureapi\",\"uri_params\":{\"rqvaltok\":\"1234\"},"
+  "\"data\":{\"cmd\":\"status\"}}";
+
+static void mg44Answer(long *aAnswersP, JsonObjectPtr aAnswer)
+{
+  // serialize like JsonComm does when sending the answer
+  string wire = aAnswer->c_strValue();
+  (*aAnswersP)++;
+}
+
+// Note: the global "status" command is answered by FeatureApi from within handleRequest(), so
+//   no mainloop cycles are needed. The benchmarks rely on that and count requests not answered
+//   synchronously, so a change in that behaviour fails the test instead of skewing the results.
+static void mg44RoundTrip(long *aAnswersP, long *aNotAnsweredP)
+{
+  long before = *aAnswersP;
+  // what the jsonapiport connection handler does with each received message
+  JsonObjectPtr request = JsonObject::objFromText(mg44Request);
+  benchMgmtApi().handleMg44Request(request, boost::bind(&mg44Answer, aAnswersP, _1));
+  if (*aAnswersP==before) (*aNotAnsweredP)++;
+}
+
+
+TEST_CASE("mg44 JSON API round trip through ManagementApi::processRequest", "[bench]")
+{
+  ErrorPtr err;
+  REQUIRE(JsonObject::objFromText(mg44Request, -1, &err));
+  long answers = 0;
+  long notAnswered = 0;
+  Benchmark::sharedBenchmark().measure("json_api_roundtrip", 10000, boost::bind(&mg44RoundTrip, &answers, &notAnswered), 1);
+  REQUIRE(notAnswered==0);
+}
+
+
+static void featureApiRequestDone(long *aAnswersP, JsonObjectPtr aResult, ErrorPtr aError)
+{
+  (*aAnswersP)++;
+}
+
+static void featureApiRequest(JsonObjectPtr aRequest, long *aAnswersP, long *aNotAnsweredP)
+{
+  long before = *aAnswersP;
+  ApiRequestPtr req = ApiRequestPtr(new APICallbackRequest(aRequest, boost::bind(&featureApiRequestDone, aAnswersP, _1, _2)));
+  FeatureApi::sharedApi()->handleRequest(req);
+  if (*aAnswersP==before) (*aNotAnsweredP)++;
+}
+
+
+TEST_CASE("FeatureApi handleRequest throughput", "[bench]")
+{
+  benchMgmtApi(); // make sure features are registered
+  JsonObjectPtr request = JsonObject::newObj();
+  request->add("cmd", JsonObject::newString("status"));
+  long answers = 0;
+  long notAnswered = 0;
+  Benchmark::sharedBenchmark().measure("featureapi_handlerequest", 10000, boost::bind(&featureApiRequest, request, &answers, &notAnswered), 1);
+  REQUIRE(notAnswered==0);
+}
+
+
+// MARK: - p44script
+
+static void runScript(ScriptSource *aSourceP)
+{
+  aSourceP->run(inherit|synchronously);
+}
+
+
+TEST_CASE("p44script typical loops", "[bench]")
+{
+  ScriptMainContextPtr ctx = StandardScriptingDomain::sharedDomain().newContext();
+  ScriptSource src(sourcecode+regular, "bench");
+  src.setSharedMainContext(ctx);
+  src.setSource(
+    "var i = 0; var s = 0;\n"
+    "while (i<1000) {\n"
+    "  if (i%3==0) s = s+i; else s = s-1;\n"
+    "  i = i+1;\n"
+    "}\n"
+    "return s;\n"
+  );
+  ScriptObjPtr res = src.run(inherit|synchronously);
+  REQUIRE(res);
+  REQUIRE(!res->isErr());
+  Benchmark::sharedBenchmark().measure("p44script_loop1000", 200, boost::bind(&runScript, &src), 1000);
+}
+
+
+// MARK: - view rendering
+
+#if ENABLE_LEDARRANGEMENT
+
+// representative scene: scrolling text over a light spot on a dark background, 30x8 pixels
+static const char *sceneConfig =
+  "{\"type\":\"stack\",\"label\":\"scene\",\"x\":0,\"y\":0,\"dx\":30,\"dy\":8,\"fullframe\":true,\"layers\":["
+  "{\"view\":{\"type\":\"lightspot\",\"x\":0,\"y\":0,\"dx\":30,\"dy\":8,\"color\":\"#4080FF\",\"extent_x\":10,\"extent_y\":4}},"
+  "{\"view\":{\"type\":\"scroller\",\"x\":0,\"y\":0,\"dx\":30,\"dy\":8,\"stepx\":0.25,\"interval\":0.02,\"view\":"
+  "{\"type\":\"text\",\"x\":0,\"y\":0,\"sizetocontent\":true,\"text\":\"p44featured benchmark scene\",\"color\":\"#FFFF00\"}}}"
+  "]}";
+
+// single 240 LED chain covering the 30x8 scene, output to /dev/null like the default mixloop/neuron chains
+static const char *nullChainSpec = "WS2812:/dev/null:240:0:30:0:8";
+
+// Note: step() only outputs a frame when the root view is dirty and the arrangement's minimum
+//   update interval has passed. The bench sets that interval to 0 and marks the view dirty, and
+//   counts steps that did not output a frame (root view still dirty afterwards).
+static void renderFrame(LEDChainArrangementPtr aArrangement, P44ViewPtr aRootView, long *aNotRenderedP)
+{
+  aRootView->makeDirty(); // force a full render and chain output on every step
+  aArrangement->step();
+  if (aRootView->isDirty()) (*aNotRenderedP)++;
+}
+
+
+TEST_CASE("view tree rendering through LEDChainArrangement to a null chain", "[bench]")
+{
+  ErrorPtr err;
+  JsonObjectPtr cfg = JsonObject::objFromText(sceneConfig, -1, &err);
+  REQUIRE(Error::isOK(err));
+  P44ViewPtr rootView;
+  err = createViewFromConfig(cfg, rootView, P44ViewPtr());
+  REQUIRE(Error::isOK(err));
+  REQUIRE(rootView);
+  LEDChainArrangementPtr arrangement;
+  LEDChainArrangement::addLEDChain(arrangement, nullChainSpec);
+  REQUIRE(arrangement);
+  arrangement->setRootView(rootView);
+  arrangement->setMinUpdateInterval(0); // no ledrefresh throttling, every step must output a frame
+  arrangement->begin(false); // no autostep, frames are rendered by the explicit step() calls
+  long notRendered = 0;
+  Benchmark::sharedBenchmark().measure("arrangement_render_30x8", 2000, boost::bind(&renderFrame, arrangement, rootView, &notRendered), 1);
+  Benchmark::sharedBenchmark().annotate("arrangement_render_30x8", "chain", JsonObject::newString(nullChainSpec));
+  arrangement->end();
+  REQUIRE(notRendered==0);
+}
+
+#endif // ENABLE_LEDARRANGEMENT
@@ -0,0 +1,41 @@
+//
+//  Copyright (c) 2020 plan44.ch / Lukas Zeller, Zurich, Switzerland
+//
+//  Author: Lukas Zeller <luz@plan44.ch>
+//
+//  This file is part of p44featured.
+//
+//  p44featured is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  p44featured is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with p44featured. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#define CATCH_CONFIG_RUNNER // we supply main() to write the benchmark results after the session
+#include "catch.hpp"
+
+#include "benchmark.hpp"
+
+using namespace p44;
+
+int main(int argc, char* argv[])
+{
+  // keep the benchmark output clean from logging
+  SETLOGLEVEL(LOG_ERR);
+  SETERRLEVEL(LOG_ERR, false);
+  int result = Catch::Session().run(argc, argv);
+  ErrorPtr err = Benchmark::sharedBenchmark().writeResults();
+  if (Error::notOK(err)) {
+    fprintf(stderr, "Cannot write benchmark results: %s\n", err->text());
+    if (result==0) result = 1;
+  }
+  return result;
+}
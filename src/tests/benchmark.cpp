@@ -0,0 +1,94 @@
+//
+//  Copyright (c) 2020 plan44.ch / Lukas Zeller, Zurich, Switzerland
+//
+//  Author: Lukas Zeller <luz@plan44.ch>
+//
+//  This file is part of p44featured.
+//
+//  p44featured is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  p44featured is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with p44featured. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "benchmark.hpp"
+
+#include "mainloop.hpp"
+#include "extutils.hpp"
+
+using namespace p44;
+
+#define DEFAULT_BENCH_RESULTS "p44featured_bench.json"
+
+
+Benchmark::Benchmark() :
+  mNumResults(0)
+{
+  mResults = JsonObject::newObj();
+}
+
+
+Benchmark& Benchmark::sharedBenchmark()
+{
+  static Benchmark sharedBench;
+  return sharedBench;
+}
+
+
+double Benchmark::measure(const string aName, long aIterations, BenchmarkBodyCB aBody, long aUnitsPerIteration)
+{
+  if (aIterations<1) aIterations = 1;
+  // warm up (first run often pays for lazy initialisation)
+  aBody();
+  MLMicroSeconds minTime = Infinite;
+  MLMicroSeconds maxTime = 0;
+  MLMicroSeconds start = MainLoop::now();
+  for (long i=0; i<aIterations; ++i) {
+    MLMicroSeconds t = MainLoop::now();
+    aBody();
+    t = MainLoop::now()-t;
+    if (t<minTime) minTime = t;
+    if (t>maxTime) maxTime = t;
+  }
+  MLMicroSeconds total = MainLoop::now()-start;
+  double avg = (double)total/aIterations;
+  JsonObjectPtr res = JsonObject::newObj();
+  res->add("iterations", JsonObject::newInt64(aIterations));
+  res->add("total_us", JsonObject::newInt64(total));
+  res->add("avg_us", JsonObject::newDouble(avg));
+  res->add("min_us", JsonObject::newInt64(minTime));
+  res->add("max_us", JsonObject::newInt64(maxTime));
+  if (total>0) {
+    res->add("units_per_sec", JsonObject::newDouble((double)aIterations*aUnitsPerIteration*Second/total));
+  }
+  mResults->add(aName.c_str(), res);
+  mNumResults++;
+  printf("%-40s %8ld iterations, avg %10.2f uS, min %lld uS, max %lld uS\n", aName.c_str(), aIterations, avg, minTime, maxTime);
+  return avg;
+}
+
+
+void Benchmark::annotate(const string aName, const string aKey, JsonObjectPtr aValue)
+{
+  JsonObjectPtr res;
+  if (mResults->get(aName.c_str(), res)) {
+    res->add(aKey.c_str(), aValue);
+  }
+}
+
+
+ErrorPtr Benchmark::writeResults()
+{
+  if (mNumResults==0) return ErrorPtr(); // nothing to write
+  const char *fn = getenv("P44_BENCH_RESULTS");
+  if (!fn) fn = DEFAULT_BENCH_RESULTS;
+  return string_tofile(fn, mResults->c_strValue());
+}
@@ -0,0 +1,69 @@
+//
+//  Copyright (c) 2020 plan44.ch / Lukas Zeller, Zurich, Switzerland
+//
+//  Author: Lukas Zeller <luz@plan44.ch>
+//
+//  This file is part of p44featured.
+//
+//  p44featured is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  p44featured is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with p44featured. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __p44featured__benchmark__
+#define __p44featured__benchmark__
+
+#include "p44utils_common.hpp"
+#include "jsonobject.hpp"
+
+using namespace std;
+
+namespace p44 {
+
+  /// body of a benchmark, called once per iteration
+  typedef boost::function<void ()> BenchmarkBodyCB;
+
+  /// collects benchmark results, to be written as JSON after the benchmark run
+  class Benchmark
+  {
+    JsonObjectPtr mResults;
+    int mNumResults;
+
+    Benchmark();
+
+  public:
+
+    static Benchmark& sharedBenchmark();
+
+    /// run a benchmark and record its result
+    /// @param aName name of the benchmark (key in the results)
+    /// @param aIterations number of times to call aBody
+    /// @param aBody the code to measure
+    /// @param aUnitsPerIteration number of units (e.g. frames, requests) processed per iteration
+    /// @return average time per iteration in microseconds
+    double measure(const string aName, long aIterations, BenchmarkBodyCB aBody, long aUnitsPerIteration = 1);
+
+    /// add extra information to an already recorded result
+    void annotate(const string aName, const string aKey, JsonObjectPtr aValue);
+
+    /// write the results collected so far
+    /// @note results go to the file named in the P44_BENCH_RESULTS environment variable,
+    ///   or to p44featured_bench.json in the current directory. Nothing is written (and an existing
+    ///   file is left untouched) when no benchmark was run, e.g. due to a test case filter.
+    /// @return ok or error
+    ErrorPtr writeResults();
+
+  };
+
+} // namespace p44
+
+#endif // __p44featured__benchmark__
@@ -0,0 +1,115 @@
+//
+//  Copyright (c) 2020 plan44.ch / Lukas Zeller, Zurich, Switzerland
+//
+//  Author: Lukas Zeller <luz@plan44.ch>
+//
+//  This file is part of p44featured.
+//
+//  p44featured is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  p44featured is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with p44featured. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "catch.hpp"
+
+#include "metrics.hpp"
+
+using namespace p44;
+
+
+// MARK: - DurationHistogram
+
+TEST_CASE("duration histogram puts values into cumulative buckets", "[metrics]")
+{
+  DurationHistogram h;
+  h.record(50*MicroSecond);
+  h.record(100*MicroSecond); // upper bound is inclusive
+  h.record(5*MilliSecond);
+  h.record(20*Second); // beyond largest finite bucket
+  REQUIRE(h.count()==4);
+  REQUIRE(h.sum()==150*MicroSecond+5*MilliSecond+20*Second);
+  REQUIRE(h.max()==20*Second);
+  string t;
+  h.exposition(t, "x", "");
+  REQUIRE(t ==
+    "x_bucket{le=\"0.0001\"} 2\n"
+    "x_bucket{le=\"0.001\"} 2\n"
+    "x_bucket{le=\"0.01\"} 3\n"
+    "x_bucket{le=\"0.1\"} 3\n"
+    "x_bucket{le=\"1\"} 3\n"
+    "x_bucket{le=\"10\"} 3\n"
+    "x_bucket{le=\"+Inf\"} 4\n"
+    "x_sum 20.005150\n"
+    "x_count 4\n"
+  );
+  h.reset();
+  REQUIRE(h.count()==0);
+  REQUIRE(h.max()==0);
+}
+
+
+TEST_CASE("duration histogram exposition with labels", "[metrics]")
+{
+  DurationHistogram h;
+  h.record(MilliSecond);
+  string t;
+  h.exposition(t, "x", "a=\"b\"");
+  REQUIRE(t.find("x_bucket{a=\"b\",le=\"0.001\"} 1\n")!=string::npos);
+  REQUIRE(t.find("x_bucket{a=\"b\",le=\"+Inf\"} 1\n")!=string::npos);
+  REQUIRE(t.find("x_sum{a=\"b\"} 0.001000\n")!=string::npos);
+  REQUIRE(t.find("x_count{a=\"b\"} 1\n")!=string::npos);
+}
+
+
+// MARK: - Metrics
+
+TEST_CASE("API latency labels are bounded to known routes", "[metrics]")
+{
+  Metrics m;
+  MLMicroSeconds now = MainLoop::now();
+  m.recordApiRequest("mg44", "featureapi", now);
+  m.recordApiRequest("mg44", "no/such/route", now);
+  m.recordApiRequest("mg44", "", now);
+  string t = m.exposition(0);
+  REQUIRE(t.find("api=\"mg44\",uri=\"featureapi\",le=\"+Inf\"} 1\n")!=string::npos);
+  REQUIRE(t.find("api=\"mg44\",uri=\"other\",le=\"+Inf\"} 2\n")!=string::npos);
+  REQUIRE(t.find("no/such/route")==string::npos);
+}
+
+
+TEST_CASE("label values are escaped", "[metrics]")
+{
+  Metrics m;
+  MLMicroSeconds now = MainLoop::now();
+  m.recordApiRequest("a\"b\\c\nd", "log", now);
+  m.recordScriptRun("q\"x", now);
+  string t = m.exposition(0);
+  REQUIRE(t.find("api=\"a\\\"b\\\\c\\nd\",uri=\"log\"")!=string::npos);
+  REQUIRE(t.find("context=\"q\\\"x\"")!=string::npos);
+}
+
+
+TEST_CASE("reset clears histograms but not script accounting", "[metrics]")
+{
+  Metrics m;
+  MLMicroSeconds now = MainLoop::now();
+  m.recordApiRequest("mg44", "log", now);
+  m.recordScriptRun("main", now);
+  m.reset();
+  string t = m.exposition(0);
+  REQUIRE(t.find("uri=\"log\"")==string::npos);
+  REQUIRE(t.find("context=\"main\"")==string::npos);
+  JsonObjectPtr acc = m.scriptAccounting();
+  JsonObjectPtr o;
+  REQUIRE(acc->get("main", o));
+  REQUIRE(o->get("runs")->int64Value()==1);
+}